@@ -5,18 +5,22 @@
 
 int main(int argc, char *argv[]) {
   if (argc < 2) {
-    fprintf(stderr, "Usage: %s 'X'\n", argv[0]);
+    fprintf(stderr, "Usage: %s codepoint\n", argv[0]);
     return 1;
   }
 
-  int index = atoi(argv[1]) - ' ';
+  int index = font_glyph(atoi(argv[1]));
+  if (index < 0) {
+    fprintf(stderr, "Code point %s is not in the font\n", argv[1]);
+    return 2;
+  }
 
   printf("P3\n");
   printf("%d %d\n", font_width[index], font_height);
   printf("255\n");
   for (int y = 0; y < font_height; y++)
     for (int x = 0; x < font_width[index]; x++) {
-      uint8_t pixel = font_indexed[index][y * font_width[index] + x];
+      uint8_t pixel = font_pixel(index, x, y);
       uint16_t color = font_palette[pixel];
       uint8_t r = color & 0x1f;
       uint8_t g = (color >> 5) & 0x1f;
@@ -24,4 +28,4 @@ int main(int argc, char *argv[]) {
       printf("%d %d %d ", r << 3, g << 3, b << 3);
     }
   printf("\n");
-}
\ No newline at end of file
+}
@@ -4,38 +4,139 @@
 #include <stdlib.h>
 #include <string.h>
 
+// Code points are looked up in two levels: the high byte selects a page and
+// the low byte a glyph inside it, so only the Basic Multilingual Plane fits
+#define MAX_CODEPOINT 0xffff
+#define MAX_GLYPHS 255
+
 uint16_t palette[256] = {0};
 
 uint8_t palette_inverse[256 * 256 * 256] = {0};
 
-int dump_char(FILE *output_h, FILE *output_c, char curr, uint8_t *indexed_image,
-              int width, int height, int fontl) {
+uint32_t charset[MAX_GLYPHS];
+
+// Glyph index + 1 for every code point, 0 meaning missing
+uint8_t glyph_of[MAX_CODEPOINT + 1] = {0};
+
+uint8_t page_index[256] = {0};
+
+int read_utf8(FILE *input, uint32_t *codepoint) {
+  int c = fgetc(input);
+  if (c == EOF)
+    return 0;
+
+  int extra;
+  if (c < 0x80) {
+    *codepoint = c;
+    extra = 0;
+  } else if ((c & 0xe0) == 0xc0) {
+    *codepoint = c & 0x1f;
+    extra = 1;
+  } else if ((c & 0xf0) == 0xe0) {
+    *codepoint = c & 0x0f;
+    extra = 2;
+  } else if ((c & 0xf8) == 0xf0) {
+    *codepoint = c & 0x07;
+    extra = 3;
+  } else
+    return -1;
+
+  for (int i = 0; i < extra; i++) {
+    c = fgetc(input);
+    if (c == EOF || (c & 0xc0) != 0x80)
+      return -1;
+    *codepoint = *codepoint << 6 | (c & 0x3f);
+  }
+
+  return 1;
+}
+
+// Reads the list of characters in the order they appear in the font image
+int read_charset(const char *path) {
+  if (!path) {
+    int count = 0;
+    for (char curr = ' '; curr <= '~'; curr++) {
+      charset[count++] = curr;
+      glyph_of[(int)curr] = count;
+    }
+    return count;
+  }
+
+  FILE *input = fopen(path, "r");
+  if (!input) {
+    fprintf(stderr, "Cannot open charset file %s\n", path);
+    return -1;
+  }
+
+  int count = 0;
+  uint32_t codepoint;
+  int result;
+  while ((result = read_utf8(input, &codepoint)) > 0) {
+    if (codepoint == '\n' || codepoint == '\r')
+      continue;
+    if (codepoint > MAX_CODEPOINT) {
+      fprintf(stderr, "Code point U+%X is outside of the supported range\n",
+              codepoint);
+      return -1;
+    }
+    if (glyph_of[codepoint]) {
+      fprintf(stderr, "Code point U+%04X is listed twice\n", codepoint);
+      return -1;
+    }
+    if (count >= MAX_GLYPHS) {
+      fprintf(stderr, "Too many glyphs, at most %d are supported\n",
+              MAX_GLYPHS);
+      return -1;
+    }
+    charset[count++] = codepoint;
+    glyph_of[codepoint] = count;
+  }
+  fclose(input);
+
+  if (result < 0) {
+    fprintf(stderr, "Charset file %s is not valid UTF-8\n", path);
+    return -1;
+  }
+
+  return count;
+}
+
+int dump_char(FILE *output_c, int glyph, uint8_t *indexed_image, int width,
+              int height, int fontl, int *offset) {
   int fontr = fontl + 1;
-  while (indexed_image[fontr] == 0)
+  while (fontr < width && indexed_image[fontr] == 0)
     fontr++;
 
+  if (fontr >= width)
+    return -1;
+
   int char_width = fontr - fontl - 1;
   int size = char_width * (height - 1);
+  int packed_size = (size + 3) / 4;
 
-  fprintf(output_c, "\n");
-  fprintf(output_c, "const uint8_t font_%d_width = %d;\n", curr, char_width);
-  fprintf(output_c, "\n");
-  fprintf(output_c,
-          "const uint8_t font_%d_indexed[%d] __attribute__((aligned(4))) = {",
-          curr, size);
-  for (int i = 0; i < size; i++) {
+  fprintf(output_c, "\n  // U+%04X, offset %d", charset[glyph], *offset);
+  for (int i = 0; i < packed_size; i++) {
+    uint8_t packed = 0;
+    for (int p = 0; p < 4 && i * 4 + p < size; p++) {
+      int pixel = i * 4 + p;
+      packed |= indexed_image[width * (1 + pixel / char_width) + fontl +
+                              pixel % char_width]
+                << (p * 2);
+    }
     if (i % 24 == 0)
       fprintf(output_c, "\n  ");
-    fprintf(
-        output_c, (i % 24) < 23 ? "0x%02x, " : "0x%02x,",
-        indexed_image[width * (1 + i / char_width) + fontl + i % char_width]);
+    fprintf(output_c, (i % 24) < 23 ? "0x%02x, " : "0x%02x,", packed);
   }
-  fprintf(output_c, "};\n");
 
+  *offset += packed_size;
   return fontr;
 }
 
 int main(int argc, char *argv[]) {
+  int glyph_count = read_charset(argc > 1 ? argv[1] : NULL);
+  if (glyph_count < 0)
+    return 1;
+
   int width, height;
   if (!read_ppm_header(&width, &height)) {
     return 2;
@@ -63,20 +164,6 @@ int main(int argc, char *argv[]) {
       indexed_image[i] = palette_inverse[color];
     }
 
-  int font_size = '~' - ' ' + 1;
-
-  FILE *output_h = fopen("out/font.h", "w");
-
-  fprintf(output_h, "#include <stdint.h>\n");
-  fprintf(output_h, "\n");
-  fprintf(output_h, "extern const int font_palette_size;\n");
-  fprintf(output_h, "extern const uint16_t font_palette[%d];\n",
-          next_free_palette);
-  fprintf(output_h, "\n");
-  fprintf(output_h, "extern const int font_height;\n");
-  fprintf(output_h, "extern const uint8_t font_width[%d];\n", font_size);
-  fprintf(output_h, "extern const uint8_t * font_indexed[%d];\n", font_size);
-
   FILE *output_c = fopen("out/font.c", "w");
 
   fprintf(output_c, "#include \"font.h\"\n");
@@ -94,35 +181,130 @@ int main(int argc, char *argv[]) {
   }
   fprintf(output_c, "\n};\n");
 
-  int fontl = 0;
-  for (char curr = ' '; curr <= '~'; curr++)
-    fontl = dump_char(output_h, output_c, curr, indexed_image, width, height,
-                      fontl);
+  // Glyphs are packed at 2 bits per pixel, the font only has 4 colors
+  fprintf(output_c,
+          "\nconst uint8_t font_data[] __attribute__((aligned(4))) = {");
+  uint16_t *offsets = calloc(glyph_count, sizeof(uint16_t));
+  uint8_t *widths = calloc(glyph_count, sizeof(uint8_t));
+  int fontl = 0, data_size = 0;
+  for (int glyph = 0; glyph < glyph_count; glyph++) {
+    offsets[glyph] = data_size;
+    int fontr = dump_char(output_c, glyph, indexed_image, width, height,
+                          fontl, &data_size);
+    if (fontr < 0) {
+      fprintf(stderr, "Font image has %d glyphs, but the charset has %d\n",
+              glyph, glyph_count);
+      return 3;
+    }
+    if (data_size > UINT16_MAX) {
+      fprintf(stderr, "Font data is too big\n");
+      return 3;
+    }
+    widths[glyph] = fontr - fontl - 1;
+    fontl = fontr;
+  }
+  fprintf(output_c, "\n};\n");
 
   fprintf(output_c, "\nconst int font_height = %d;\n", height - 1);
+  fprintf(output_c, "\nconst int font_glyph_count = %d;\n", glyph_count);
 
-  fprintf(output_c, "\nconst uint8_t font_width[%d] = {", font_size);
-  for (char curr = ' '; curr <= '~'; curr++) {
-    if ((curr - ' ') % 8 == 0)
+  fprintf(output_c, "\nconst uint8_t font_width[%d] = {", glyph_count);
+  for (int i = 0; i < glyph_count; i++) {
+    if (i % 12 == 0)
       fprintf(output_c, "\n  ");
-    fprintf(output_c,
-            ((curr - ' ') % 8) < 7 ? "font_%d_width, " : "font_%d_width,",
-            curr);
+    fprintf(output_c, (i % 12) < 11 ? "%d, " : "%d,", widths[i]);
   }
   fprintf(output_c, "\n};\n");
 
-  fprintf(output_c, "\nconst uint8_t * font_indexed[%d] = {", font_size);
-  for (char curr = ' '; curr <= '~'; curr++) {
-    if ((curr - ' ') % 8 == 0)
+  fprintf(output_c, "\nconst uint16_t font_offset[%d] = {", glyph_count);
+  for (int i = 0; i < glyph_count; i++) {
+    if (i % 12 == 0)
       fprintf(output_c, "\n  ");
-    fprintf(output_c,
-            ((curr - ' ') % 8) < 7 ? "font_%d_indexed, " : "font_%d_indexed,",
-            curr);
+    fprintf(output_c, (i % 12) < 11 ? "%d, " : "%d,", offsets[i]);
+  }
+  fprintf(output_c, "\n};\n");
+
+  // Page 0 is always empty, so missing pages need no special casing
+  int page_count = 1;
+  for (int page = 0; page < 256; page++)
+    for (int low = 0; low < 256; low++)
+      if (glyph_of[page << 8 | low]) {
+        page_index[page] = page_count++;
+        break;
+      }
+
+  fprintf(output_c, "\nconst uint8_t font_page_index[256] = {");
+  for (int i = 0; i < 256; i++) {
+    if (i % 16 == 0)
+      fprintf(output_c, "\n  ");
+    fprintf(output_c, (i % 16) < 15 ? "%d, " : "%d,", page_index[i]);
+  }
+  fprintf(output_c, "\n};\n");
+
+  fprintf(output_c, "\nconst uint8_t font_pages[%d][256] = {\n  {0},",
+          page_count);
+  for (int page = 0; page < 256; page++) {
+    if (!page_index[page])
+      continue;
+    fprintf(output_c, "\n  // U+%02X00", page);
+    fprintf(output_c, "\n  {");
+    for (int low = 0; low < 256; low++) {
+      if (low % 16 == 0)
+        fprintf(output_c, "\n    ");
+      fprintf(output_c, (low % 16) < 15 ? "%d, " : "%d,",
+              glyph_of[page << 8 | low]);
+    }
+    fprintf(output_c, "\n  },");
   }
   fprintf(output_c, "\n};\n");
 
   fclose(output_c);
+
+  FILE *output_h = fopen("out/font.h", "w");
+
+  fprintf(output_h, "#pragma once\n");
+  fprintf(output_h, "\n");
+  fprintf(output_h, "#include <stdint.h>\n");
+  fprintf(output_h, "\n");
+  fprintf(output_h, "extern const int font_palette_size;\n");
+  fprintf(output_h, "extern const uint16_t font_palette[%d];\n",
+          next_free_palette);
+  fprintf(output_h, "\n");
+  fprintf(output_h, "extern const int font_height;\n");
+  fprintf(output_h, "extern const int font_glyph_count;\n");
+  fprintf(output_h, "extern const uint8_t font_width[%d];\n", glyph_count);
+  fprintf(output_h, "extern const uint16_t font_offset[%d];\n", glyph_count);
+  fprintf(output_h, "extern const uint8_t font_data[%d];\n", data_size);
+  fprintf(output_h, "\n");
+  fprintf(output_h, "extern const uint8_t font_page_index[256];\n");
+  fprintf(output_h, "extern const uint8_t font_pages[%d][256];\n", page_count);
+  fprintf(output_h, "\n");
+  fprintf(output_h, "// Returns the glyph for a code point, or -1 if missing\n");
+  fprintf(output_h, "static inline int font_glyph(uint32_t codepoint) {\n");
+  fprintf(output_h, "  if (codepoint > 0x%x)\n", MAX_CODEPOINT);
+  fprintf(output_h, "    return -1;\n");
+  fprintf(output_h, "  return font_pages[font_page_index[codepoint >> 8]]"
+                    "[codepoint & 0xff] - 1;\n");
+  fprintf(output_h, "}\n");
+  fprintf(output_h, "\n");
+  fprintf(output_h, "static inline uint8_t font_pixel(int glyph, int x, "
+                    "int y) {\n");
+  fprintf(output_h, "  int pixel = y * font_width[glyph] + x;\n");
+  fprintf(output_h, "  return (font_data[font_offset[glyph] + (pixel >> 2)] "
+                    ">> ((pixel & 3) << 1)) & 3;\n");
+  fprintf(output_h, "}\n");
+
   fclose(output_h);
 
+  // List of code points, used to generate the public font images
+  FILE *output_mk = fopen("out/font.mk", "w");
+
+  fprintf(output_mk, "FONT_CODEPOINTS :=");
+  for (int i = 0; i < glyph_count; i++)
+    fprintf(output_mk, " %d", charset[i]);
+  fprintf(output_mk, "\n");
+
+  fclose(output_mk);
+
   return 0;
 }
@@ -9,8 +9,16 @@ uint16_t palette[256] = {0};
 uint8_t palette_inverse[256 * 256 * 256] = {0};
 
 int main(int argc, char *argv[]) {
-  if (argc < 2) {
-    fprintf(stderr, "Usage: %s image_name < input.ppm > output.c\n", argv[0]);
+  const char *kinds[] = {"IMAGE_FULLSCREEN", "IMAGE_CHAT", "IMAGE_ICON"};
+  const char *kind_names[] = {"fullscreen", "chat", "icon"};
+  int kind = argc > 2 ? -1 : 0;
+  for (int i = 0; argc > 2 && i < 3; i++)
+    if (strcmp(argv[2], kind_names[i]) == 0)
+      kind = i;
+
+  if (argc < 2 || kind < 0) {
+    fprintf(stderr, "Usage: %s image_name [fullscreen|chat|icon] < input.ppm\n",
+            argv[0]);
     return 1;
   }
 
@@ -19,6 +27,13 @@ int main(int argc, char *argv[]) {
     return 2;
   }
 
+  // draw_fullscreen_image copies the whole screen
+  if (kind == 0 && (width != 240 || height != 160)) {
+    fprintf(stderr, "Full screen images must be 240x160, not %dx%d\n", width,
+            height);
+    return 3;
+  }
+
   int next_free_palette = 1;
 
   uint8_t *indexed_image = malloc(width * height);
@@ -77,8 +92,10 @@ int main(int argc, char *argv[]) {
   fprintf(output_c, "#include \"%s.h\"\n", image_name);
   fprintf(output_c, "#include <stdint.h>\n");
   fprintf(output_c, "\n");
-  fprintf(output_h, "const image %s_image = { %s_indexed, %s_palette, %d };\n",
-          image_name, image_name, image_name, next_free_palette);
+  fprintf(output_c, "const image %s_image = {\n", image_name);
+  fprintf(output_c, "  %s_indexed, %s_palette, %d, %d, %d, %s,\n", image_name,
+          image_name, next_free_palette, width, height, kinds[kind]);
+  fprintf(output_c, "};\n");
   fprintf(output_c, "\n");
   fprintf(output_c, "const int %s_palette_size = %d;\n", image_name,
           next_free_palette);
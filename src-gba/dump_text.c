@@ -0,0 +1,450 @@
+// Prerenders the text and labels of every scene the logic lists in
+// compiled_scenes, so the game can blit them instead of drawing them glyph by
+// glyph, and without reading the text itself. Text
+// that would take more than max_text_bytes as spans is compressed instead,
+// and decoded while it's printed
+#include "font.h"
+#include "huffman_utils.h"
+#include "layout.h"
+#include "lib/dialog.h"
+#include "lib/graphics.h"
+#include "lib/text.h"
+#include "logic.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// put_pixel takes a 16 bit offset, so that's as far as text can land
+#define BUFFER_SIZE 0x20000
+#define UNTOUCHED 0xff
+
+extern uint8_t font_color_index[4];
+
+typedef struct Span {
+  int x;
+  int y;
+  int width;
+  int height;
+  int data;
+} span;
+
+typedef struct Blob {
+  uint8_t *data;
+  int size;
+} blob;
+
+typedef struct Prerendered {
+  int text_id;
+  // What the scene looked like, for the scenes sharing its text_id
+  uint32_t hash;
+  bool ending;
+  const image *portrait;
+  int first_span;
+  int span_count;
+  int dialog;
+} prerendered;
+
+uint16_t buffer[BUFFER_SIZE / 2];
+
+span *spans = 0;
+int spans_count = 0;
+
+blob *blobs = 0;
+int blobs_count = 0;
+
+prerendered *scenes = 0;
+int scenes_count = 0;
+
+int errors = 0;
+
+int max_text_bytes = 1024;
+
+// Interned dialog texts, each stored once however many scenes use it
+char **dialogs = 0;
+int dialogs_count = 0;
+
+int intern_dialog(char *text) {
+  for (int i = 0; i < dialogs_count; i++)
+    if (strcmp(dialogs[i], text) == 0)
+      return i;
+
+  dialogs = realloc(dialogs, (dialogs_count + 1) * sizeof(char *));
+  dialogs[dialogs_count] = text;
+  return dialogs_count++;
+}
+
+// Lines are decoded into a fixed window, so they must fit in it
+bool fits_dialog_window(const char *text) {
+  while (1) {
+    const char *end = strchr(text, '\n');
+    int length = end ? end - text : strlen(text);
+    if (length >= DIALOG_LINE_SIZE)
+      return false;
+    if (!end)
+      return true;
+    text = end + 1;
+  }
+}
+
+// Identical text (the same label in the same place) is only stored once
+int intern_blob(uint8_t *data, int size) {
+  for (int i = 0; i < blobs_count; i++)
+    if (blobs[i].size == size && memcmp(blobs[i].data, data, size) == 0) {
+      free(data);
+      return i;
+    }
+
+  blobs = realloc(blobs, (blobs_count + 1) * sizeof(blob));
+  blobs[blobs_count] = (blob){data, size};
+  return blobs_count++;
+}
+
+void add_span(int x, int y, int width, int height) {
+  const uint8_t *pixels = (const uint8_t *)buffer;
+  int left = x & 1;
+  int stride = (left + width + 3) / 4;
+  uint8_t *data = calloc(stride * height, 1);
+
+  for (int row = 0; row < height; row++)
+    for (int i = 0; i < width; i++) {
+      int j = left + i;
+      data[row * stride + j / 4] |= pixels[(y + row) * WIDTH + x + i]
+                                    << ((j % 4) * 2);
+    }
+
+  spans = realloc(spans, (spans_count + 1) * sizeof(span));
+  spans[spans_count++] =
+      (span){x, y, width, height, intern_blob(data, stride * height)};
+}
+
+typedef struct Run {
+  int x;
+  int width;
+  int y;
+} run;
+
+/* Splits whatever print_text drew into rectangles: every run of touched
+ * pixels in a row either extends the span right above it or starts one */
+int extract_spans() {
+  const uint8_t *pixels = (const uint8_t *)buffer;
+  int first = spans_count;
+
+  run open[WIDTH], next[WIDTH];
+  int open_count = 0;
+
+  for (int y = 0; y <= HEIGHT; y++) {
+    int next_count = 0;
+
+    for (int x = 0; y < HEIGHT && x < WIDTH; x++) {
+      if (pixels[y * WIDTH + x] == UNTOUCHED)
+        continue;
+
+      int width = 1;
+      while (x + width < WIDTH && pixels[y * WIDTH + x + width] != UNTOUCHED)
+        width++;
+
+      next[next_count] = (run){x, width, y};
+      for (int i = 0; i < open_count; i++)
+        if (open[i].x == x && open[i].width == width) {
+          next[next_count].y = open[i].y;
+          open[i].width = 0;
+        }
+      next_count++;
+
+      x += width;
+    }
+
+    // Whatever wasn't extended ends here
+    for (int i = 0; i < open_count; i++)
+      if (open[i].width)
+        add_span(open[i].x, open[i].y, open[i].width, y - open[i].y);
+
+    memcpy(open, next, next_count * sizeof(run));
+    open_count = next_count;
+  }
+
+  return spans_count - first;
+}
+
+// Text that wrapped around VRAM can't be blitted
+bool draws_outside() {
+  const uint8_t *pixels = (const uint8_t *)buffer;
+  for (int i = WIDTH * HEIGHT; i < BUFFER_SIZE; i++)
+    if (pixels[i] != UNTOUCHED)
+      return true;
+  return false;
+}
+
+// How many new bytes of spans the text alone would take
+int text_bytes(int current_scene, scene scene) {
+  int spans_before = spans_count, blobs_before = blobs_count;
+
+  memset(buffer, UNTOUCHED, sizeof(buffer));
+  print_scene_text(buffer, current_scene, scene);
+  extract_spans();
+
+  int bytes = 0;
+  for (int b = blobs_before; b < blobs_count; b++) {
+    bytes += blobs[b].size;
+    free(blobs[b].data);
+  }
+  spans_count = spans_before;
+  blobs_count = blobs_before;
+  return bytes;
+}
+
+void prerender(const compiled_scene *compiled) {
+  scene scene = compiled->scene;
+  bool ending = compiled->ending;
+  // Only the sign matters to the layout
+  int current_scene = ending ? -1 : 0;
+
+  if (!scene.text_id || !scene.text) {
+    fprintf(stderr, "Compiled scenes need a text_id and their text\n");
+    errors++;
+    return;
+  }
+
+  uint32_t hash = scene_text_hash(scene);
+  const image *portrait = scene_portrait(scene);
+  for (int i = 0; i < scenes_count; i++) {
+    if (scenes[i].text_id != scene.text_id)
+      continue;
+    if (scenes[i].hash != hash || scenes[i].ending != ending ||
+        scenes[i].portrait != portrait) {
+      fprintf(stderr, "Scenes with text id %d look different\n",
+              scene.text_id);
+      errors++;
+    }
+    return;
+  }
+
+  memset(buffer, UNTOUCHED, sizeof(buffer));
+  print_scene_text(buffer, current_scene, scene);
+  print_scene_labels(buffer, scene);
+  if (draws_outside()) {
+    fprintf(stderr, "Text id %d draws outside of the screen\n",
+            scene.text_id);
+    errors++;
+    return;
+  }
+
+  int dialog = -1;
+  if (text_bytes(current_scene, scene) > max_text_bytes &&
+      fits_dialog_window(scene.text))
+    dialog = intern_dialog(scene.text);
+
+  memset(buffer, UNTOUCHED, sizeof(buffer));
+  if (dialog < 0)
+    print_scene_text(buffer, current_scene, scene);
+  print_scene_labels(buffer, scene);
+
+  int first_span = spans_count;
+  int span_count = extract_spans();
+
+  scenes = realloc(scenes, (scenes_count + 1) * sizeof(prerendered));
+  scenes[scenes_count++] = (prerendered){
+      scene.text_id, hash, ending, portrait, first_span, span_count, dialog};
+}
+
+void dump_dialogs() {
+  long frequencies[HUFFMAN_SYMBOLS] = {0};
+  for (int d = 0; d < dialogs_count; d++)
+    for (const char *c = dialogs[d];; c++) {
+      frequencies[(uint8_t)*c]++;
+      if (!*c)
+        break;
+    }
+
+  uint8_t lengths[HUFFMAN_SYMBOLS];
+  uint16_t codes[HUFFMAN_SYMBOLS];
+  uint16_t counts[HUFFMAN_MAX_BITS + 1];
+  uint8_t symbols[HUFFMAN_SYMBOLS];
+  huffman_lengths(frequencies, HUFFMAN_MAX_BITS, lengths);
+  int used = huffman_codes(lengths, HUFFMAN_MAX_BITS, codes, counts, symbols);
+
+  bit_writer writer = {0};
+  long *offsets = calloc(dialogs_count + 1, sizeof(long));
+  long plain_size = 0;
+  for (int d = 0; d < dialogs_count; d++) {
+    offsets[d] = writer.bits;
+    for (const char *c = dialogs[d];; c++) {
+      write_code(&writer, codes[(uint8_t)*c], lengths[(uint8_t)*c]);
+      if (!*c)
+        break;
+    }
+    plain_size += strlen(dialogs[d]) + 1;
+  }
+  // The reader loads the byte after the last bit it used
+  int size = writer.bits / 8 + 1;
+  write_code(&writer, 0, 8);
+
+  FILE *output_h = fopen("out/dialog_data.h", "w");
+
+  fprintf(output_h, "#pragma once\n");
+  fprintf(output_h, "\n");
+  fprintf(output_h, "#include <stdint.h>\n");
+  fprintf(output_h, "#include \"../src-gba/lib/dialog.h\"\n");
+  fprintf(output_h, "\n");
+  fprintf(output_h, "extern const huffman dialog_code;\n");
+  fprintf(output_h, "extern const uint8_t dialog_data[%d];\n", size);
+  fprintf(output_h, "extern const dialog_text dialog_texts[%d];\n",
+          dialogs_count ? dialogs_count : 1);
+
+  fclose(output_h);
+
+  FILE *output_c = fopen("out/dialog_data.c", "w");
+
+  fprintf(output_c, "#include \"dialog_data.h\"\n");
+  fprintf(output_c, "#include <stdint.h>\n");
+  fprintf(output_c, "\n");
+  fprintf(output_c, "const uint16_t dialog_code_counts[%d] = {",
+          HUFFMAN_MAX_BITS + 1);
+  for (int i = 0; i <= HUFFMAN_MAX_BITS; i++)
+    fprintf(output_c, i < HUFFMAN_MAX_BITS ? "%d, " : "%d", counts[i]);
+  fprintf(output_c, "};\n");
+  fprintf(output_c, "\n");
+  fprintf(output_c, "const uint8_t dialog_code_symbols[%d] = {",
+          used ? used : 1);
+  for (int i = 0; i < used; i++) {
+    if (i % 16 == 0)
+      fprintf(output_c, "\n  ");
+    fprintf(output_c, (i % 16) < 15 ? "0x%02x, " : "0x%02x,", symbols[i]);
+  }
+  if (!used)
+    fprintf(output_c, "0");
+  fprintf(output_c, "\n};\n");
+  fprintf(output_c, "\n");
+  fprintf(output_c, "const huffman dialog_code = {dialog_code_counts, "
+                    "dialog_code_symbols};\n");
+
+  fprintf(output_c, "\n");
+  fprintf(output_c,
+          "const uint8_t dialog_data[%d] __attribute__((aligned(4))) = {",
+          size);
+  for (int i = 0; i < size; i++) {
+    if (i % 24 == 0)
+      fprintf(output_c, "\n  ");
+    fprintf(output_c, (i % 24) < 23 ? "0x%02x, " : "0x%02x,", writer.data[i]);
+  }
+  fprintf(output_c, "};\n");
+
+  fprintf(output_c, "\nconst dialog_text dialog_texts[%d] = {",
+          dialogs_count ? dialogs_count : 1);
+  for (int d = 0; d < dialogs_count; d++)
+    fprintf(output_c, "\n  {%ld, %d},", offsets[d], count_lines(dialogs[d]));
+  if (!dialogs_count)
+    fprintf(output_c, "{0}");
+  fprintf(output_c, "\n};\n");
+
+  fclose(output_c);
+
+  printf("Compressed %d dialog texts from %ld to %d bytes\n", dialogs_count,
+         plain_size, size);
+}
+
+int by_text_id(const void *l, const void *r) {
+  int left = ((const prerendered *)l)->text_id;
+  int right = ((const prerendered *)r)->text_id;
+  return left < right ? -1 : left > right;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1)
+    max_text_bytes = atoi(argv[1]);
+
+  // Draw font pixels as their own index, so spans are in font palette space
+  for (int i = 0; i < 4; i++)
+    font_color_index[i] = i;
+
+  for (int i = 0; i < compiled_scenes_count; i++)
+    prerender(&compiled_scenes[i]);
+  if (errors)
+    return 1;
+
+  if (spans_count > UINT16_MAX || dialogs_count > INT16_MAX) {
+    fprintf(stderr, "Too many spans (%d) or dialogs (%d)\n", spans_count,
+            dialogs_count);
+    return 1;
+  }
+
+  qsort(scenes, scenes_count, sizeof(prerendered), by_text_id);
+
+  FILE *output_h = fopen("out/prerendered.h", "w");
+
+  fprintf(output_h, "#pragma once\n");
+  fprintf(output_h, "\n");
+  fprintf(output_h, "#include <stdint.h>\n");
+  fprintf(output_h, "#include \"../src-gba/lib/text.h\"\n");
+  fprintf(output_h, "\n");
+  fprintf(output_h, "typedef struct PrerenderedScene {\n");
+  fprintf(output_h, "  int text_id;\n");
+  fprintf(output_h, "  uint16_t first_span;\n");
+  fprintf(output_h, "  uint16_t span_count;\n");
+  fprintf(output_h,
+          "  // Index in dialog_texts, or -1 if the text is in the spans\n");
+  fprintf(output_h, "  int16_t dialog;\n");
+  fprintf(output_h, "} prerendered_scene;\n");
+  fprintf(output_h, "\n");
+  fprintf(output_h, "// Sorted by text_id\n");
+  fprintf(output_h, "extern const int prerendered_count;\n");
+  fprintf(output_h, "extern const prerendered_scene prerendered[%d];\n",
+          scenes_count ? scenes_count : 1);
+  fprintf(output_h, "\n");
+  fprintf(output_h, "extern const text_span prerendered_spans[%d];\n",
+          spans_count ? spans_count : 1);
+
+  fclose(output_h);
+
+  FILE *output_c = fopen("out/prerendered.c", "w");
+
+  fprintf(output_c, "#include \"prerendered.h\"\n");
+  fprintf(output_c, "#include <stdint.h>\n");
+
+  int total_size = 0;
+  for (int b = 0; b < blobs_count; b++) {
+    fprintf(output_c, "\n");
+    fprintf(output_c,
+            "const uint8_t prerendered_%d_data[%d] "
+            "__attribute__((aligned(4))) = {",
+            b, blobs[b].size);
+    for (int i = 0; i < blobs[b].size; i++) {
+      if (i % 24 == 0)
+        fprintf(output_c, "\n  ");
+      fprintf(output_c, (i % 24) < 23 ? "0x%02x, " : "0x%02x,",
+              blobs[b].data[i]);
+    }
+    fprintf(output_c, "};\n");
+    total_size += blobs[b].size;
+  }
+
+  fprintf(output_c, "\nconst text_span prerendered_spans[%d] = {",
+          spans_count ? spans_count : 1);
+  for (int s = 0; s < spans_count; s++)
+    fprintf(output_c, "\n  {%d, %d, %d, %d, prerendered_%d_data},",
+            spans[s].x, spans[s].y, spans[s].width, spans[s].height,
+            spans[s].data);
+  if (!spans_count)
+    fprintf(output_c, "{0}");
+  fprintf(output_c, "\n};\n");
+
+  fprintf(output_c, "\nconst int prerendered_count = %d;\n", scenes_count);
+  fprintf(output_c, "\nconst prerendered_scene prerendered[%d] = {",
+          scenes_count ? scenes_count : 1);
+  for (int i = 0; i < scenes_count; i++)
+    fprintf(output_c, "\n  {%d, %d, %d, %d},", scenes[i].text_id,
+            scenes[i].first_span, scenes[i].span_count, scenes[i].dialog);
+  if (!scenes_count)
+    fprintf(output_c, "{0}");
+  fprintf(output_c, "\n};\n");
+
+  fclose(output_c);
+
+  dump_dialogs();
+
+  printf("Prerendered %d texts into %d spans, %d bytes\n", scenes_count,
+         spans_count, total_size);
+
+  return 0;
+}
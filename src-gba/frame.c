@@ -0,0 +1,68 @@
+#include "frame.h"
+#include "dialog_data.h"
+#include "layout.h"
+#include "lib/dialog.h"
+#include "lib/graphics.h"
+#include "lib/text.h"
+#include "logic.h"
+#include "prerendered.h"
+#include <stdint.h>
+
+const prerendered_scene *find_prerendered(scene scene) {
+  if (!scene.text_id)
+    return 0;
+
+  int low = 0, high = prerendered_count;
+  while (low < high) {
+    int middle = (low + high) / 2;
+    if (prerendered[middle].text_id < scene.text_id)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  if (low == prerendered_count || prerendered[low].text_id != scene.text_id)
+    return 0;
+  return &prerendered[low];
+}
+
+void draw_scene(volatile uint16_t *buffer, int current_scene, scene scene) {
+  const image *portrait = scene_portrait(scene);
+  const image *image = scene.image;
+
+  if (image && !portrait)
+    draw_fullscreen_image(buffer, *image);
+  else {
+    reset_palette(buffer);
+    clear_screen(buffer, 0);
+  }
+
+  if (portrait)
+    draw_image_at(buffer, *portrait, PORTRAIT_MARGIN, PORTRAIT_MARGIN);
+
+  setup_font_palette();
+
+  const prerendered_scene *text = find_prerendered(scene);
+  if (!text) {
+    if (scene.text)
+      print_scene_text(buffer, current_scene, scene);
+    print_scene_labels(buffer, scene);
+    return;
+  }
+
+  // Long text is streamed out of the compressed dialog, the spans then only
+  // hold the labels
+  if (text->dialog >= 0) {
+    const dialog_text *dialog = &dialog_texts[text->dialog];
+    int x, y;
+    enum Align halign, valign;
+    scene_text_position(current_scene, scene, &x, &y, &halign, &valign);
+
+    dialog_reader reader;
+    dialog_open(&reader, &dialog_code, dialog_data, dialog->bit);
+    print_dialog(buffer, &reader, dialog->lines, x, y, halign, valign);
+  }
+
+  for (int i = 0; i < text->span_count; i++)
+    draw_text_span(buffer, &prerendered_spans[text->first_span + i]);
+}
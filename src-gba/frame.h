@@ -0,0 +1,11 @@
+#pragma once
+
+#include "logic.h"
+#include "prerendered.h"
+#include <stdint.h>
+
+// Returns the text prerendered for a scene, or NULL if it must be printed
+const prerendered_scene *find_prerendered(scene scene);
+
+// Draws a whole scene: background, text and choice labels
+void draw_scene(volatile uint16_t *buffer, int current_scene, scene scene);
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "lib/dialog.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Computes the code length of every symbol, 0 for unused ones. Codes longer
+ * than max_bits are avoided by flattening the frequencies and trying again */
+void huffman_lengths(const long *frequencies, int max_bits, uint8_t *lengths) {
+  long weight[2 * HUFFMAN_SYMBOLS];
+  int parent[2 * HUFFMAN_SYMBOLS];
+  long scaled[HUFFMAN_SYMBOLS];
+  memcpy(scaled, frequencies, sizeof(scaled));
+
+  while (1) {
+    int nodes = 0, used = 0;
+    for (int i = 0; i < HUFFMAN_SYMBOLS; i++) {
+      weight[nodes] = scaled[i];
+      parent[nodes++] = -1;
+      if (scaled[i])
+        used++;
+    }
+
+    memset(lengths, 0, HUFFMAN_SYMBOLS);
+    if (used == 1) {
+      for (int i = 0; i < HUFFMAN_SYMBOLS; i++)
+        if (scaled[i])
+          lengths[i] = 1;
+      return;
+    }
+
+    // Merge the two lightest roots until one is left
+    for (int merges = 0; merges < used - 1; merges++) {
+      int first = -1, second = -1;
+      for (int i = 0; i < nodes; i++) {
+        if (!weight[i] || parent[i] >= 0)
+          continue;
+        if (first < 0 || weight[i] < weight[first]) {
+          second = first;
+          first = i;
+        } else if (second < 0 || weight[i] < weight[second])
+          second = i;
+      }
+      weight[nodes] = weight[first] + weight[second];
+      parent[nodes] = -1;
+      parent[first] = parent[second] = nodes++;
+    }
+
+    int longest = 0;
+    for (int i = 0; i < HUFFMAN_SYMBOLS; i++) {
+      if (!scaled[i])
+        continue;
+      for (int node = i; parent[node] >= 0; node = parent[node])
+        lengths[i]++;
+      if (lengths[i] > longest)
+        longest = lengths[i];
+    }
+
+    if (longest <= max_bits)
+      return;
+
+    for (int i = 0; i < HUFFMAN_SYMBOLS; i++)
+      if (scaled[i])
+        scaled[i] = (scaled[i] + 1) / 2;
+  }
+}
+
+/* Assigns canonical codes: shorter codes first, ties broken by symbol. Fills
+ * the per length counts and the symbols in code order, like the decoder in
+ * lib/dialog.c expects, and returns the number of used symbols */
+int huffman_codes(const uint8_t *lengths, int max_bits, uint16_t *codes,
+                  uint16_t *counts, uint8_t *symbols) {
+  int used = 0;
+  memset(counts, 0, (max_bits + 1) * sizeof(uint16_t));
+  for (int length = 1; length <= max_bits; length++)
+    for (int i = 0; i < HUFFMAN_SYMBOLS; i++)
+      if (lengths[i] == length) {
+        counts[length]++;
+        symbols[used++] = i;
+      }
+
+  uint16_t next = 0;
+  for (int length = 1, s = 0; length <= max_bits; length++) {
+    for (int i = 0; i < counts[length]; i++)
+      codes[symbols[s++]] = next++;
+    next <<= 1;
+  }
+
+  return used;
+}
+
+typedef struct BitWriter {
+  uint8_t *data;
+  long bits;
+  long capacity;
+} bit_writer;
+
+// Codes are written most significant bit first, filling bytes from bit 0
+void write_code(bit_writer *writer, uint16_t code, int length) {
+  for (int i = length - 1; i >= 0; i--) {
+    if (writer->bits / 8 + 1 >= writer->capacity) {
+      writer->capacity = writer->capacity ? writer->capacity * 2 : 1024;
+      writer->data = realloc(writer->data, writer->capacity);
+    }
+    if (writer->bits % 8 == 0)
+      writer->data[writer->bits / 8] = 0;
+    writer->data[writer->bits / 8] |= ((code >> i) & 1) << (writer->bits % 8);
+    writer->bits++;
+  }
+}
@@ -0,0 +1,92 @@
+#include "layout.h"
+#include "lib/graphics.h"
+#include "lib/text.h"
+#include "lib/utils.h"
+#include "logic.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+void scene_labels(scene scene, char **left, char **right) {
+  *left = 0;
+  *right = 0;
+  switch (scene.choices_count) {
+  case 1:
+    *right = concat("A/B: ", strlen(scene.choices_labels[0])
+                                 ? scene.choices_labels[0]
+                                 : "Next");
+    break;
+  case 2:
+    *left = concat("B: ", scene.choices_labels[0]);
+    *right = concat("A: ", scene.choices_labels[1]);
+    break;
+  }
+}
+
+uint32_t hash_string(uint32_t hash, const char *text) {
+  // FNV-1a, including the terminator to separate strings
+  do {
+    hash = (hash ^ (uint8_t)*text) * 16777619u;
+  } while (*text++);
+  return hash;
+}
+
+uint32_t scene_text_hash(scene scene) {
+  uint32_t hash = hash_string(2166136261u, scene.text);
+  for (int i = 0; i < scene.choices_count; i++)
+    hash = hash_string(hash, scene.choices_labels[i]);
+  return hash;
+}
+
+const image *scene_portrait(scene scene) {
+  // The logic asks for a portrait by pointing at a small variant
+  if (!scene.image || scene.image->kind == IMAGE_FULLSCREEN)
+    return 0;
+  return scene.image;
+}
+
+// Left edge of the text area
+int text_left(const image *portrait) {
+  return portrait ? portrait->width + 2 * PORTRAIT_MARGIN : 0;
+}
+
+void scene_text_position(int current_scene, scene scene, int *x, int *y,
+                         enum Align *halign, enum Align *valign) {
+  int left = text_left(scene_portrait(scene));
+  *x = (left + WIDTH) / 2;
+  *halign = ALIGN_MIDDLE;
+  if (current_scene < 0) {
+    *y = HEIGHT / 2;
+    *valign = ALIGN_MIDDLE;
+  } else {
+    *y = 0;
+    *valign = ALIGN_BEGIN;
+  }
+}
+
+int scene_text_width(int current_scene, scene scene) {
+  return WIDTH - text_left(scene_portrait(scene));
+}
+
+void print_scene_text(volatile uint16_t *buffer, int current_scene,
+                      scene scene) {
+  int x, y;
+  enum Align halign, valign;
+  scene_text_position(current_scene, scene, &x, &y, &halign, &valign);
+  print_text(buffer, scene.text, x, y, halign, valign);
+}
+
+void print_scene_labels(volatile uint16_t *buffer, scene scene) {
+  char *left_label;
+  char *right_label;
+  scene_labels(scene, &left_label, &right_label);
+
+  if (left_label) {
+    print_text(buffer, left_label, 0, HEIGHT, ALIGN_BEGIN, ALIGN_END);
+    free(left_label);
+  }
+  if (right_label) {
+    print_text(buffer, right_label, WIDTH, HEIGHT, ALIGN_END, ALIGN_END);
+    free(right_label);
+  }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "lib/graphics.h"
+#include "lib/text.h"
+#include "logic.h"
+#include <stdint.h>
+
+// Distance of the portrait from the screen edges and from the text
+#define PORTRAIT_MARGIN 4
+
+// Builds the choice labels shown at the bottom of the screen, either can be
+// NULL. The caller owns the returned strings
+void scene_labels(scene scene, char **left, char **right);
+
+// Identifies the text and labels of a scene, to check that scenes sharing a
+// text_id look the same
+uint32_t scene_text_hash(scene scene);
+
+// The image drawn as a portrait next to the text, or NULL if the scene
+// image (if any) fills the screen
+const image *scene_portrait(scene scene);
+
+// Where the scene text goes, which depends on whether the game is over and on
+// the portrait
+void scene_text_position(int current_scene, scene scene, int *x, int *y,
+                         enum Align *halign, enum Align *valign);
+// How wide the scene text can be
+int scene_text_width(int current_scene, scene scene);
+
+void print_scene_text(volatile uint16_t *buffer, int current_scene,
+                      scene scene);
+void print_scene_labels(volatile uint16_t *buffer, scene scene);
@@ -0,0 +1,74 @@
+#include "dialog.h"
+#include "font.h"
+#include "text.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+void dialog_open(dialog_reader *reader, const huffman *code,
+                 const uint8_t *data, uint32_t bit) {
+  int symbols = 0;
+  for (int length = 0; length <= HUFFMAN_MAX_BITS; length++) {
+    reader->counts[length] = code->counts[length];
+    symbols += code->counts[length];
+  }
+  for (int i = 0; i < symbols && i < HUFFMAN_SYMBOLS; i++)
+    reader->symbols[i] = code->symbols[i];
+
+  reader->data = data;
+  reader->bit = bit;
+  reader->byte = data[bit >> 3];
+  reader->done = false;
+}
+
+int read_bit(dialog_reader *reader) {
+  int result = (reader->byte >> (reader->bit & 7)) & 1;
+  reader->bit++;
+  if ((reader->bit & 7) == 0)
+    reader->byte = reader->data[reader->bit >> 3];
+  return result;
+}
+
+uint8_t read_symbol(dialog_reader *reader) {
+  int value = 0, first = 0, index = 0;
+  for (int length = 1; length <= HUFFMAN_MAX_BITS; length++) {
+    value |= read_bit(reader);
+    int count = reader->counts[length];
+    if (value - first < count)
+      return reader->symbols[index + value - first];
+    index += count;
+    first = (first + count) << 1;
+    value <<= 1;
+  }
+  // Corrupt data, end the text
+  return 0;
+}
+
+int dialog_read_line(dialog_reader *reader, char *line, int size) {
+  if (reader->done)
+    return -1;
+
+  int length = 0;
+  while (1) {
+    uint8_t symbol = read_symbol(reader);
+    if (symbol == 0)
+      reader->done = true;
+    if (symbol == 0 || symbol == '\n')
+      break;
+    // The compiler makes sure lines fit, this only guards against bad data
+    if (length < size - 1)
+      line[length++] = symbol;
+  }
+  line[length] = 0;
+  return length;
+}
+
+void print_dialog(volatile uint16_t *buffer, dialog_reader *reader, int lines,
+                  int x, int y, enum Align halign, enum Align valign) {
+  char line[DIALOG_LINE_SIZE];
+
+  y -= align_offset(font_height * lines, valign);
+  while (dialog_read_line(reader, line, DIALOG_LINE_SIZE) >= 0) {
+    print_line(buffer, line, x, y, halign);
+    y += font_height;
+  }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "text.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Dialog text is compressed with a canonical Huffman code over bytes, a 0
+ * symbol ending each text, and decoded a line at a time */
+#define HUFFMAN_MAX_BITS 15
+#define HUFFMAN_SYMBOLS 256
+#define DIALOG_LINE_SIZE 128
+
+typedef struct Huffman {
+  // Number of codes of each length, counts[0] is unused
+  const uint16_t *counts;
+  // Symbols ordered by code
+  const uint8_t *symbols;
+} huffman;
+
+typedef struct DialogText {
+  uint32_t bit;
+  uint16_t lines;
+} dialog_text;
+
+/* The code is copied out of the cartridge when the reader is opened, so
+ * decoding only reads the cartridge once per byte of compressed data */
+typedef struct DialogReader {
+  uint16_t counts[HUFFMAN_MAX_BITS + 1];
+  uint8_t symbols[HUFFMAN_SYMBOLS];
+  const uint8_t *data;
+  uint32_t bit;
+  // Byte the next bit comes from
+  uint8_t byte;
+  bool done;
+} dialog_reader;
+
+void dialog_open(dialog_reader *reader, const huffman *code,
+                 const uint8_t *data, uint32_t bit);
+
+// Decodes the next line into line, returns its length or -1 at the end
+int dialog_read_line(dialog_reader *reader, char *line, int size);
+
+void print_dialog(volatile uint16_t *buffer, dialog_reader *reader, int lines,
+                  int x, int y, enum Align halign, enum Align valign);
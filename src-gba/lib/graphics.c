@@ -87,13 +87,10 @@ volatile uint16_t *flip_buffers(volatile uint16_t *buffer) {
 
 /* clear the screen to black */
 void clear_screen(volatile uint16_t *buffer, uint8_t color) {
-  uint16_t row, col;
-  /* set each pixel black */
-  for (row = 0; row < HEIGHT; row++) {
-    for (col = 0; col < WIDTH; col++) {
-      put_pixel(buffer, row, col, color);
-    }
-  }
+  /* set two pixels at a time, there's nothing to preserve */
+  uint16_t pair = (color << 8) | color;
+  for (int i = 0; i < HEIGHT * WIDTH / 2; i++)
+    buffer[i] = pair;
 }
 
 void add_image_palette(volatile uint16_t *buffer, image image) {
@@ -111,3 +108,29 @@ void draw_fullscreen_image(volatile uint16_t *buffer, image image) {
     buffer[i / 2] =
         ((image.indexed[i + 1] ^ xor) << 8) | (image.indexed[i] ^ xor);
 }
+
+void draw_image_at(volatile uint16_t *buffer, image image, int x, int y) {
+  if (!image.indexed || !image.palette)
+    return;
+
+  /* the image indices are shifted to wherever its colors land */
+  uint8_t base = next_palette_index;
+  for (int i = 0; i < image.palette_size; i++)
+    add_color_16(image.palette[i]);
+
+  for (int row = 0; row < image.height; row++) {
+    const uint8_t *source = image.indexed + row * image.width;
+    int col = 0;
+
+    if (x & 1)
+      for (; col < image.width; col++)
+        put_pixel(buffer, y + row, x + col, source[col] + base);
+
+    volatile uint16_t *target = buffer + (((y + row) * WIDTH + x) >> 1);
+    for (; col + 1 < image.width; col += 2)
+      *target++ = ((source[col + 1] + base) << 8) | (source[col] + base);
+
+    if (col < image.width)
+      put_pixel(buffer, y + row, x + col, source[col] + base);
+  }
+}
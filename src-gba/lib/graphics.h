@@ -3,20 +3,26 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// Which of the conversions of an art file an image is
+enum ImageKind { IMAGE_FULLSCREEN, IMAGE_CHAT, IMAGE_ICON };
+
 typedef struct Image {
   const uint8_t *indexed;
   const uint16_t *palette;
   int palette_size;
+  int width;
+  int height;
+  enum ImageKind kind;
 } image;
 
 /* pointers to the front and back buffers - the front buffer is the start
  * of the screen array and the back buffer is a pointer to the second half
  */
-volatile uint16_t *front_buffer;
-volatile uint16_t *back_buffer;
+extern volatile uint16_t *front_buffer;
+extern volatile uint16_t *back_buffer;
 
 /* the display control pointer points to the gba graphics register */
-volatile uint16_t *display_control;
+extern volatile uint16_t *display_control;
 
 /* the width and height of the screen */
 #define WIDTH 240
@@ -44,3 +50,6 @@ void clear_screen(volatile uint16_t *buffer, uint8_t color);
 
 // Resets the palette and draws an image
 void draw_fullscreen_image(volatile uint16_t *buffer, image image);
+// Adds the image colors to the palette and draws it with its top left corner
+// at x, y. Even x are faster
+void draw_image_at(volatile uint16_t *buffer, image image, int x, int y);
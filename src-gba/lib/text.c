@@ -5,21 +5,58 @@
 #include <stdint.h>
 #include <string.h>
 
-uint8_t font_color_index[3] = {0};
+uint8_t font_color_index[4] = {0};
 
-bool is_printable(char curr) { return curr >= ' ' && curr <= '~'; }
+// Two font pixels (a nibble of a text span) to two palette indices
+uint16_t font_color_pair[16] = {0};
 
-int print_char(volatile uint16_t *buffer, char curr, int x, int y) {
-  if (!is_printable(curr))
+uint32_t utf8_next(const char **text) {
+  const uint8_t *curr = (const uint8_t *)*text;
+  uint8_t lead = *curr;
+  if (!lead)
     return 0;
 
-  int index = curr - ' ';
+  uint32_t codepoint;
+  int extra;
+  if (lead < 0x80) {
+    *text += 1;
+    return lead;
+  } else if ((lead & 0xe0) == 0xc0) {
+    codepoint = lead & 0x1f;
+    extra = 1;
+  } else if ((lead & 0xf0) == 0xe0) {
+    codepoint = lead & 0x0f;
+    extra = 2;
+  } else if ((lead & 0xf8) == 0xf0) {
+    codepoint = lead & 0x07;
+    extra = 3;
+  } else {
+    *text += 1;
+    return UTF8_INVALID;
+  }
+
+  for (int i = 1; i <= extra; i++) {
+    if ((curr[i] & 0xc0) != 0x80) {
+      // Resync on the next byte, which is never past the terminator
+      *text += i;
+      return UTF8_INVALID;
+    }
+    codepoint = codepoint << 6 | (curr[i] & 0x3f);
+  }
+
+  *text += 1 + extra;
+  return codepoint;
+}
+
+int print_glyph(volatile uint16_t *buffer, int glyph, int x, int y) {
+  if (glyph < 0)
+    return 0;
 
-  int char_width = font_width[index];
+  int char_width = font_width[glyph];
 
   for (int fy = 0; fy < font_height; fy++) {
     for (int fx = 0; fx < char_width; fx++) {
-      uint8_t pixel = font_indexed[index][fy * char_width + fx];
+      uint8_t pixel = font_pixel(glyph, fx, fy);
       uint8_t indexed_color = font_color_index[pixel];
       put_pixel(buffer, y + fy, x + fx, indexed_color);
     }
@@ -30,87 +67,115 @@ int print_char(volatile uint16_t *buffer, char curr, int x, int y) {
 
 int count_lines(const char *text) {
   int lines = text[0] == 0 ? 0 : 1;
-  for (int i = 0; i < strlen(text); i++)
+  for (int i = 0; text[i]; i++)
     if (text[i] == '\n')
       lines++;
   return lines;
 }
 
 int measure_first_line_width(const char *text) {
-  int len = strlen(text);
   int current_row_width = 1;
-  for (int i = 0; i < len; i++) {
-    char curr = text[i];
+  uint32_t curr;
+  while ((curr = utf8_next(&text))) {
     if (curr == '\n')
       return current_row_width;
 
-    if (!is_printable(curr))
+    int glyph = font_glyph(curr);
+    if (glyph < 0)
       continue;
 
-    int index = curr - ' ';
-
-    current_row_width += font_width[index] + 1;
+    current_row_width += font_width[glyph] + 1;
   }
   return current_row_width;
 }
 
+int measure_text_width(const char *text) {
+  int width = 0;
+  while (1) {
+    width = imax(width, measure_first_line_width(text));
+    text = strchr(text, '\n');
+    if (!text)
+      return width;
+    text++;
+  }
+}
+
+int align_offset(int size, enum Align align) {
+  switch (align) {
+  case ALIGN_BEGIN:
+    return 0;
+  case ALIGN_MIDDLE:
+    return size / 2;
+  case ALIGN_END:
+    return size;
+  }
+  return 0;
+}
+
+void print_line(volatile uint16_t *buffer, const char *line, int x, int y,
+                enum Align halign) {
+  if (!*line || *line == '\n')
+    return;
+
+  int space = font_glyph(' ');
+
+  x -= align_offset(measure_first_line_width(line), halign);
+  print_glyph(buffer, space, x, y);
+  x++;
+
+  uint32_t curr;
+  while ((curr = utf8_next(&line)) && curr != '\n') {
+    x += print_glyph(buffer, font_glyph(curr), x, y);
+    x += print_glyph(buffer, space, x, y);
+  }
+}
+
 void print_text(volatile uint16_t *buffer, const char *text, int x, int y,
                 enum Align halign, enum Align valign) {
-  int ox = x;
-  if (valign != ALIGN_BEGIN) {
-    int lines = count_lines(text);
-    int height = font_height * lines;
-    switch (valign) {
-    case ALIGN_BEGIN:
-      break;
-    case ALIGN_MIDDLE:
-      y -= height / 2;
-      break;
-    case ALIGN_END:
-      y -= height;
-      break;
-    }
+  if (valign != ALIGN_BEGIN)
+    y -= align_offset(font_height * count_lines(text), valign);
+
+  while (1) {
+    print_line(buffer, text, x, y, halign);
+    text = strchr(text, '\n');
+    if (!text)
+      return;
+    text++;
+    y += font_height;
   }
+}
 
-  bool start_of_line = true;
-
-  for (int i = 0;; i++) {
-    char curr = text[i];
-    if (!curr)
-      break;
+uint8_t span_pixel(const uint8_t *row, int i) {
+  return font_color_index[(row[i >> 2] >> ((i & 3) << 1)) & 3];
+}
 
-    if (curr == '\n') {
-      start_of_line = true;
-      y += font_height;
-      x = ox;
-      continue;
+void draw_text_span(volatile uint16_t *buffer, const text_span *span) {
+  int x = span->x & ~1;
+  int left = span->x & 1;
+  int end = left + span->width;
+  int stride = (end + 3) >> 2;
+  const uint8_t *row = span->data;
+
+  for (int y = span->y; y < span->y + span->height; y++, row += stride) {
+    int i = 0;
+    if (left) {
+      put_pixel(buffer, y, span->x, span_pixel(row, 1));
+      i = 2;
     }
 
-    if (start_of_line) {
-      start_of_line = false;
-
-      int width = measure_first_line_width(text + i);
-      switch (halign) {
-      case ALIGN_BEGIN:
-        break;
-      case ALIGN_MIDDLE:
-        x -= width / 2;
-        break;
-      case ALIGN_END:
-        x -= width;
-        break;
-      }
-
-      print_char(buffer, ' ', x, y);
-      x++;
-    }
+    volatile uint16_t *target = buffer + ((y * WIDTH + x + i) >> 1);
+    for (; i + 1 < end; i += 2)
+      *target++ = font_color_pair[(row[i >> 2] >> ((i & 2) << 1)) & 0xf];
 
-    x += print_char(buffer, curr, x, y);
-    x += print_char(buffer, ' ', x, y);
+    if (i < end)
+      put_pixel(buffer, y, x + i, span_pixel(row, i));
   }
 }
 
 void setup_font_palette() {
   for (int i = 0; i < font_palette_size; i++)
     font_color_index[i] = add_color_16(font_palette[i]);
+  for (int i = 0; i < 16; i++)
+    font_color_pair[i] =
+        font_color_index[i >> 2] << 8 | font_color_index[i & 3];
 }
@@ -4,10 +4,35 @@
 
 enum Align { ALIGN_BEGIN, ALIGN_MIDDLE, ALIGN_END };
 
+/* A rectangle of text rendered ahead of time with the font palette, 2 bits
+ * per pixel. Rows start at the even column x & ~1 and are padded to a whole
+ * byte, so pixels come in pairs that can be written as a single halfword */
+typedef struct TextSpan {
+  int16_t x;
+  int16_t y;
+  int16_t width;
+  int16_t height;
+  const uint8_t *data;
+} text_span;
+
+// Returned by utf8_next for malformed sequences
+#define UTF8_INVALID 0xfffd
+
+// Decodes the code point at *text and advances past it, returns 0 at the end
+uint32_t utf8_next(const char **text);
+
 int count_lines(const char *text);
 int measure_text_width(const char *text);
 
+// How far back from x or y text of the given size starts
+int align_offset(int size, enum Align align);
+
+// Prints up to the first newline or the end of the text
+void print_line(volatile uint16_t *buffer, const char *line, int x, int y,
+                enum Align halign);
 void print_text(volatile uint16_t *buffer, const char *text, int x, int y,
                 enum Align halign, enum Align valign);
 
+void draw_text_span(volatile uint16_t *buffer, const text_span *span);
+
 void setup_font_palette();
@@ -17,7 +17,6 @@ char *concat(const char *left, const char *right) {
   char *result = malloc(len);
   strcpy(result, left);
   strcpy(result + left_len, right);
-  result[len] = 0;
   return result;
 }
 
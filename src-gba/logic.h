@@ -1,14 +1,44 @@
 #pragma once
 
 #include "lib/graphics.h"
+#include <stdbool.h>
+#include <stdint.h>
 
 typedef struct Scene {
   char *text;
   const image *image;
   int choices_count;
   const char *const *choices_labels;
+  // Identifies the text and labels so the build can compile them ahead of
+  // time, 0 if it shouldn't. Scenes sharing an id must look the same
+  int text_id;
 } scene;
 
+/* Only the host tools read text that has a text_id, to compile it. The
+ * logic can wrap it in SCENE_TEXT to leave it out of the ROM */
+#ifdef COMPILED_TEXT
+#define SCENE_TEXT(text) NULL
+#else
+#define SCENE_TEXT(text) text
+#endif
+
+/* Every scene the logic can return with a text_id, once per id, so the
+ * build compiles all of them without walking the game. Endings are the scenes
+ * returned with current_scene < 0, which are laid out differently */
+typedef struct CompiledScene {
+  scene scene;
+  bool ending;
+} compiled_scene;
+
+extern const compiled_scene compiled_scenes[];
+extern const int compiled_scenes_count;
+
 extern const scene main_scene;
 
 scene step(int *current_scene, int choice);
+
+/* Sums up the part of the current progress that step() reads, so the host
+ * tools walk the scenes without going through every possible progress. From
+ * the same scene, two states with the same summary must return the same scenes
+ * and end up with the same summaries. 0 if step() doesn't read the progress */
+uint32_t step_progress();
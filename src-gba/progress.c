@@ -0,0 +1,371 @@
+#include "progress.h"
+#include "lib/utils.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+volatile uint8_t *sram = (volatile uint8_t *)0x0e000000;
+
+/* emulators and flashers look for this string to know the cartridge has
+ * battery backed SRAM */
+__attribute__((used, aligned(4))) const char sram_tag[] = "SRAM_V113";
+
+/////////////
+// Bitsets //
+/////////////
+
+// Stored instead of -1, to fit in a record
+#define NOBODY 0xffff
+
+bool bit_get(const uint32_t *bits, int index) {
+  return (bits[index >> 5] >> (index & 31)) & 1;
+}
+
+void bit_set(uint32_t *bits, int index) {
+  bits[index >> 5] |= 1u << (index & 31);
+}
+
+progress_state progress = {.current_person = NOBODY};
+
+// Zones come from the logic, their counts are derived from met
+struct Zones {
+  const uint8_t *person_zone;
+  int people_count;
+  uint16_t met[PROGRESS_MAX_ZONES];
+  uint16_t size[PROGRESS_MAX_ZONES];
+} zones = {0};
+
+bool valid_person(int person) {
+  return person >= 0 && person < PROGRESS_MAX_PEOPLE;
+}
+
+bool valid_quiz(int quiz) { return quiz >= 0 && quiz < PROGRESS_MAX_QUIZZES; }
+
+// The zone of a person, or -1 if there's none
+int zone_of(int person) {
+  if (person >= zones.people_count ||
+      zones.person_zone[person] >= PROGRESS_MAX_ZONES)
+    return -1;
+  return zones.person_zone[person];
+}
+
+/////////////
+// Journal //
+/////////////
+
+/* SRAM holds two banks, the valid one starts with the magic. A bank
+ * is the magic followed by records of [type][low][high], ended by a 0xff type.
+ * The type is written last, so a record cut short by a power loss reads as the
+ * end of the journal. When the active bank is full the state is written
+ * compacted to the other bank, which then takes the magic */
+
+#define BANK_SIZE 0x4000
+#define RECORD_SIZE 3
+#define RECORDS_START 4
+#define RECORD_END 0xff
+
+enum RecordType {
+  RECORD_MET,
+  RECORD_TICKET,
+  RECORD_USED_TICKET,
+  RECORD_WRONG_ANSWER,
+  RECORD_CORRECT_ANSWER,
+  RECORD_CURRENT_PERSON,
+  RECORD_WON,
+};
+
+const uint8_t magic[RECORDS_START] = {'S', 'D', 'C', 1};
+
+int active_bank = 0;
+// Offset of the end record in the active bank
+int journal_end = RECORDS_START;
+
+bool bank_has_magic(int bank) {
+  for (int i = 0; i < RECORDS_START; i++)
+    if (sram[bank * BANK_SIZE + i] != magic[i])
+      return false;
+  return true;
+}
+
+/* Empties a bank, which isn't valid until commit_bank. Until then the old
+ * bank keeps the magic, so it's the one loaded after a power loss */
+void erase_bank(int bank) {
+  volatile uint8_t *base = sram + bank * BANK_SIZE;
+  base[0] = 0;
+  for (int i = RECORDS_START; i < BANK_SIZE; i++)
+    base[i] = RECORD_END;
+  for (int i = 1; i < RECORDS_START; i++)
+    base[i] = magic[i];
+
+  active_bank = bank;
+  journal_end = RECORDS_START;
+}
+
+// Makes the active bank the valid one
+void commit_bank() {
+  sram[active_bank * BANK_SIZE] = magic[0];
+  // Both banks being valid for a moment is fine, they agree
+  sram[(1 - active_bank) * BANK_SIZE] = 0;
+}
+
+void write_record(uint8_t type, uint16_t value) {
+  volatile uint8_t *record = sram + active_bank * BANK_SIZE + journal_end;
+  record[1] = value & 0xff;
+  record[2] = value >> 8;
+  record[0] = type;
+  journal_end += RECORD_SIZE;
+}
+
+// Writes the whole state as records in a fresh bank
+void compact() {
+  erase_bank(1 - active_bank);
+
+  for (int i = 0; i < PROGRESS_MAX_PEOPLE; i++) {
+    if (bit_get(progress.met, i))
+      write_record(RECORD_MET, i);
+    if (bit_get(progress.tickets, i))
+      write_record(RECORD_TICKET, i);
+    if (bit_get(progress.used_tickets, i))
+      write_record(RECORD_USED_TICKET, i);
+  }
+  for (int i = 0; i < PROGRESS_MAX_QUIZZES; i++)
+    if (bit_get(progress.correct, i))
+      write_record(RECORD_CORRECT_ANSWER, i);
+    else if (bit_get(progress.answered, i))
+      write_record(RECORD_WRONG_ANSWER, i);
+  if (progress.current_person != NOBODY)
+    write_record(RECORD_CURRENT_PERSON, progress.current_person);
+  if (progress.won)
+    write_record(RECORD_WON, 0);
+
+  commit_bank();
+}
+
+void append_record(uint8_t type, uint16_t value) {
+  // Keep room for the end record
+  if (journal_end + RECORD_SIZE >= BANK_SIZE)
+    compact();
+  write_record(type, value);
+}
+
+////////////
+// Events //
+////////////
+
+/* each event changes the state in memory and returns whether anything
+ * changed, so only changes make it to the journal */
+
+bool meet(int person) {
+  if (!valid_person(person) || bit_get(progress.met, person))
+    return false;
+  bit_set(progress.met, person);
+  int zone = zone_of(person);
+  if (zone >= 0)
+    zones.met[zone]++;
+  return true;
+}
+
+bool give_ticket(int person) {
+  if (!valid_person(person) || bit_get(progress.tickets, person))
+    return false;
+  bit_set(progress.tickets, person);
+  return true;
+}
+
+bool use_ticket(int person) {
+  if (!valid_person(person) || bit_get(progress.used_tickets, person))
+    return false;
+  bit_set(progress.used_tickets, person);
+  return true;
+}
+
+bool answer(int quiz, bool correct) {
+  if (!valid_quiz(quiz))
+    return false;
+  if (correct && !bit_get(progress.correct, quiz)) {
+    bit_set(progress.answered, quiz);
+    bit_set(progress.correct, quiz);
+    return true;
+  }
+  if (!bit_get(progress.answered, quiz)) {
+    bit_set(progress.answered, quiz);
+    return true;
+  }
+  return false;
+}
+
+bool set_current_person(int person) {
+  if (!valid_person(person) || progress.current_person == person)
+    return false;
+  progress.current_person = person;
+  return true;
+}
+
+bool win() {
+  if (progress.won)
+    return false;
+  progress.won = true;
+  return true;
+}
+
+void replay(uint8_t type, uint16_t value) {
+  switch (type) {
+  case RECORD_MET:
+    meet(value);
+    break;
+  case RECORD_TICKET:
+    give_ticket(value);
+    break;
+  case RECORD_USED_TICKET:
+    use_ticket(value);
+    break;
+  case RECORD_WRONG_ANSWER:
+    answer(value, false);
+    break;
+  case RECORD_CORRECT_ANSWER:
+    answer(value, true);
+    break;
+  case RECORD_CURRENT_PERSON:
+    set_current_person(value);
+    break;
+  case RECORD_WON:
+    win();
+    break;
+  }
+}
+
+void clear_progress() {
+  progress = (progress_state){.current_person = NOBODY};
+  progress_set_zones(zones.person_zone, zones.people_count);
+}
+
+void progress_load() {
+  clear_progress();
+
+  if (bank_has_magic(0))
+    active_bank = 0;
+  else if (bank_has_magic(1))
+    active_bank = 1;
+  else {
+    erase_bank(0);
+    commit_bank();
+    return;
+  }
+
+  volatile uint8_t *base = sram + active_bank * BANK_SIZE;
+  journal_end = RECORDS_START;
+  while (journal_end + RECORD_SIZE < BANK_SIZE) {
+    uint8_t type = base[journal_end];
+    if (type == RECORD_END)
+      break;
+    replay(type, base[journal_end + 1] | base[journal_end + 2] << 8);
+    journal_end += RECORD_SIZE;
+  }
+}
+
+void progress_reset() {
+  clear_progress();
+  erase_bank(1 - active_bank);
+  commit_bank();
+}
+
+void progress_snapshot(progress_state *state) { *state = progress; }
+
+void progress_restore(const progress_state *state) {
+  progress = *state;
+  progress_set_zones(zones.person_zone, zones.people_count);
+}
+
+void progress_set_zones(const uint8_t *person_zone, int people_count) {
+  zones.person_zone = person_zone;
+  zones.people_count =
+      person_zone ? imin(people_count, PROGRESS_MAX_PEOPLE) : 0;
+
+  for (int i = 0; i < PROGRESS_MAX_ZONES; i++) {
+    zones.met[i] = 0;
+    zones.size[i] = 0;
+  }
+  for (int i = 0; i < zones.people_count; i++) {
+    int zone = zone_of(i);
+    if (zone < 0)
+      continue;
+    zones.size[zone]++;
+    if (bit_get(progress.met, i))
+      zones.met[zone]++;
+  }
+}
+
+//////////////
+// Progress //
+//////////////
+
+bool progress_met(int person) {
+  return valid_person(person) && bit_get(progress.met, person);
+}
+
+void progress_meet(int person) {
+  if (meet(person))
+    append_record(RECORD_MET, person);
+}
+
+bool progress_has_ticket(int person) {
+  return valid_person(person) && bit_get(progress.tickets, person);
+}
+
+void progress_give_ticket(int person) {
+  if (give_ticket(person))
+    append_record(RECORD_TICKET, person);
+}
+
+bool progress_used_ticket(int person) {
+  return valid_person(person) && bit_get(progress.used_tickets, person);
+}
+
+void progress_use_ticket(int person) {
+  if (use_ticket(person))
+    append_record(RECORD_USED_TICKET, person);
+}
+
+bool progress_answered(int quiz) {
+  return valid_quiz(quiz) && bit_get(progress.answered, quiz);
+}
+
+bool progress_answered_correctly(int quiz) {
+  return valid_quiz(quiz) && bit_get(progress.correct, quiz);
+}
+
+void progress_answer(int quiz, bool correct) {
+  if (answer(quiz, correct))
+    append_record(correct ? RECORD_CORRECT_ANSWER : RECORD_WRONG_ANSWER, quiz);
+}
+
+int progress_current_person() {
+  return progress.current_person == NOBODY ? -1 : progress.current_person;
+}
+
+void progress_set_current_person(int person) {
+  if (set_current_person(person))
+    append_record(RECORD_CURRENT_PERSON, person);
+}
+
+bool progress_won() { return progress.won; }
+
+void progress_win() {
+  if (win())
+    append_record(RECORD_WON, 0);
+}
+
+int progress_zone_met(int zone) {
+  return zone >= 0 && zone < PROGRESS_MAX_ZONES ? zones.met[zone] : 0;
+}
+
+int progress_zone_size(int zone) {
+  return zone >= 0 && zone < PROGRESS_MAX_ZONES ? zones.size[zone] : 0;
+}
+
+bool progress_zone_unlocked(int zone) {
+  if (zone <= 0)
+    return true;
+  int size = progress_zone_size(zone - 1);
+  return !size ||
+         progress_zone_met(zone - 1) * 100 > ZONE_UNLOCK_PERCENT * size;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Game progress: who the player met, which quizzes they answered, which
+ * tickets they hold. People and quizzes are numbered by the logic, the state
+ * lives in bitsets so every query is a couple of loads. Changes are appended
+ * to a journal in cartridge SRAM as they happen, so saving costs a record
+ * rather than rewriting the whole state */
+
+#define PROGRESS_MAX_PEOPLE 256
+#define PROGRESS_MAX_QUIZZES 1024
+#define PROGRESS_MAX_ZONES 16
+
+// A zone opens once more than this share of the previous one has been met
+#define ZONE_UNLOCK_PERCENT 60
+
+#define PROGRESS_WORDS(bits) (((bits) + 31) / 32)
+
+// Everything that's saved, the zone counts are derived from it
+typedef struct ProgressState {
+  uint32_t met[PROGRESS_WORDS(PROGRESS_MAX_PEOPLE)];
+  uint32_t tickets[PROGRESS_WORDS(PROGRESS_MAX_PEOPLE)];
+  uint32_t used_tickets[PROGRESS_WORDS(PROGRESS_MAX_PEOPLE)];
+  uint32_t answered[PROGRESS_WORDS(PROGRESS_MAX_QUIZZES)];
+  uint32_t correct[PROGRESS_WORDS(PROGRESS_MAX_QUIZZES)];
+  uint16_t current_person;
+  bool won;
+} progress_state;
+
+/* the cartridge SRAM, 32KB accessed a byte at a time. A pointer so the host
+ * tools can put it somewhere else */
+extern volatile uint8_t *sram;
+
+// Restores the progress from SRAM, or starts a new game if there's none
+void progress_load();
+// Forgets everything, in memory and in SRAM
+void progress_reset();
+
+/* For the host tools walking the scenes from every state: restoring only
+ * changes the state in memory, SRAM is left alone */
+void progress_snapshot(progress_state *state);
+void progress_restore(const progress_state *state);
+
+/* Zones are optional: person_zone gives the zone of every person, and is
+ * kept around. The per zone counts are kept up to date from then on, people
+ * in zones past PROGRESS_MAX_ZONES are left out */
+void progress_set_zones(const uint8_t *person_zone, int people_count);
+
+bool progress_met(int person);
+void progress_meet(int person);
+
+bool progress_has_ticket(int person);
+void progress_give_ticket(int person);
+bool progress_used_ticket(int person);
+void progress_use_ticket(int person);
+
+bool progress_answered(int quiz);
+bool progress_answered_correctly(int quiz);
+// A quiz stays correct once it's been answered correctly
+void progress_answer(int quiz, bool correct);
+
+// Returns -1 before the player picks anyone
+int progress_current_person();
+void progress_set_current_person(int person);
+
+bool progress_won();
+void progress_win();
+
+int progress_zone_met(int zone);
+int progress_zone_size(int zone);
+// The first zone is always open, the others need the previous one done.
+// Empty zones count as done
+bool progress_zone_unlocked(int zone);
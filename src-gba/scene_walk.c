@@ -0,0 +1,389 @@
+// Walks every scene reachable from main_scene on the host and reports the
+// transitions that are most expensive to draw, that use the most heap, and
+// whose text doesn't fit on the screen, or wasn't compiled like the logic
+// draws it. Exits with 1 if anything is wrong,
+// including transitions that take more VRAM accesses than the budget.
+#define _DEFAULT_SOURCE
+#include "font.h"
+#include "frame.h"
+#include "layout.h"
+#include "lib/graphics.h"
+#include "lib/text.h"
+#include "lib/utils.h"
+#include "logic.h"
+#include "prerendered.h"
+#include "progress.h"
+#include "walk_utils.h"
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+typedef struct Transition {
+  int from;
+  int choice;
+  int to;
+  int text_id;
+  long vram;
+  long host_ns;
+  long heap;
+  long leaked;
+  int overflow_x;
+  int overflow_y;
+  int missing_glyphs;
+  // The text_id isn't in compiled_scenes, so the cartridge draws no text
+  bool uncompiled;
+  // The compiled scene with that text_id looks different
+  bool miscompiled;
+} transition;
+
+/* A frame is 280896 cycles, and drawing takes at least a handful of cycles
+ * per VRAM access, so past this a transition takes more than a frame */
+#define DEFAULT_VRAM_BUDGET 70000
+
+transition *transitions = 0;
+int transitions_count = 0;
+int transitions_capacity = 0;
+
+///////////////////
+// Heap tracking //
+///////////////////
+
+/* malloc and friends are wrapped at link time (-Wl,--wrap), so allocations
+ * made by the logic and the library are counted too */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+long heap_current = 0;
+long heap_peak = 0;
+
+void heap_add(long size) {
+  heap_current += size;
+  if (heap_current > heap_peak)
+    heap_peak = heap_current;
+}
+
+void *__wrap_malloc(size_t size) {
+  void *result = __real_malloc(size);
+  if (result)
+    heap_add(malloc_usable_size(result));
+  return result;
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  void *result = __real_calloc(count, size);
+  if (result)
+    heap_add(malloc_usable_size(result));
+  return result;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  long old_size = ptr ? malloc_usable_size(ptr) : 0;
+  void *result = __real_realloc(ptr, size);
+  if (result) {
+    heap_current -= old_size;
+    heap_add(malloc_usable_size(result));
+  }
+  return result;
+}
+
+void __wrap_free(void *ptr) {
+  if (ptr)
+    heap_current -= malloc_usable_size(ptr);
+  __real_free(ptr);
+}
+
+//////////////
+// Hardware //
+//////////////
+
+/* the library talks to the hardware through fixed addresses, so back them
+ * with plain memory: I/O registers, palette, VRAM and SRAM. put_pixel wraps its
+ * 16 bit offset for text drawn off screen, so VRAM gets enough slack for the
+ * back buffer plus 128KB: that's reported as an overflow rather than a crash */
+bool map_hardware() {
+  const struct {
+    uintptr_t address;
+    size_t size;
+  } regions[] = {
+      {0x4000000, 0x1000},
+      {0x5000000, 0x1000},
+      {0x6000000, 0x2a000},
+      {0xe000000, 0x8000}};
+
+  for (int i = 0; i < sizeof(regions) / sizeof(regions[0]); i++) {
+    void *mapped = mmap((void *)regions[i].address, regions[i].size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1,
+                        0);
+    if (mapped != (void *)regions[i].address) {
+      fprintf(stderr, "Cannot map the GBA memory at 0x%lx\n",
+              (unsigned long)regions[i].address);
+      return false;
+    }
+  }
+
+  /* wait_vblank spins on the scanline counter, buttons are active low */
+  *(volatile uint16_t *)0x4000006 = HEIGHT;
+  *(volatile uint16_t *)0x4000130 = 0x3ff;
+  return true;
+}
+
+////////////////
+// Cost model //
+////////////////
+
+/* The host is nothing like the GBA, so the render cost is estimated as the
+ * number of 16 bit VRAM accesses: put_pixel reads and writes a halfword,
+ * while clear_screen and the image blits write two pixels at a time */
+long text_vram(const char *text) {
+  int space = font_glyph(' ');
+  int space_width = space < 0 ? 0 : font_width[space];
+  long pixels = 0;
+  bool start_of_line = true;
+
+  uint32_t curr;
+  while ((curr = utf8_next(&text))) {
+    if (curr == '\n') {
+      start_of_line = true;
+      continue;
+    }
+
+    if (start_of_line) {
+      start_of_line = false;
+      pixels += space_width;
+    }
+
+    int glyph = font_glyph(curr);
+    pixels += (glyph < 0 ? 0 : font_width[glyph]) + space_width;
+  }
+
+  return 2 * pixels * font_height;
+}
+
+// draw_text_span writes pixel pairs, only odd edges go through put_pixel
+long spans_vram(const prerendered_scene *text) {
+  long vram = 0;
+  for (int i = 0; i < text->span_count; i++) {
+    const text_span *span = &prerendered_spans[text->first_span + i];
+    int left = span->x & 1;
+    int pairs = (span->width - left) / 2;
+    int tail = (span->width - left) % 2;
+    vram += (long)span->height * (pairs + 2 * (left + tail));
+  }
+  return vram;
+}
+
+int count_missing_glyphs(const char *text) {
+  int missing = 0;
+  uint32_t curr;
+  while ((curr = utf8_next(&text)))
+    if (curr != '\n' && font_glyph(curr) < 0)
+      missing++;
+  return missing;
+}
+
+// The entry of compiled_scenes with the text_id of the scene, if any
+const compiled_scene *find_compiled(scene scene) {
+  for (int i = 0; i < compiled_scenes_count; i++)
+    if (compiled_scenes[i].scene.text_id == scene.text_id)
+      return &compiled_scenes[i];
+  return 0;
+}
+
+void measure(int from, int choice, int current_scene, scene scene,
+             void *data) {
+  transition result = {from, choice, current_scene, scene.text_id};
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  draw_scene(back_buffer, current_scene, scene);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  // The heap window started at the end of the previous visit, so it covers
+  // both step() and drawing
+  result.heap = heap_peak - *(long *)data;
+  result.leaked = heap_current - *(long *)data;
+  result.host_ns = (end.tv_sec - start.tv_sec) * 1000000000L +
+                   (end.tv_nsec - start.tv_nsec);
+
+  const image *portrait = scene_portrait(scene);
+  if (scene.text_id) {
+    const compiled_scene *compiled = find_compiled(scene);
+    result.uncompiled = !compiled;
+    result.miscompiled =
+        compiled &&
+        (scene_text_hash(compiled->scene) != scene_text_hash(scene) ||
+         compiled->ending != (current_scene < 0) ||
+         scene_portrait(compiled->scene) != portrait);
+  }
+
+  result.vram = WIDTH * HEIGHT / 2;
+  if (portrait)
+    result.vram += portrait->height * ((portrait->width + 1) / 2);
+  const prerendered_scene *text = find_prerendered(scene);
+  if (text)
+    result.vram += spans_vram(text);
+  if (!text || text->dialog >= 0)
+    result.vram += text_vram(scene.text);
+
+  char *left_label;
+  char *right_label;
+  scene_labels(scene, &left_label, &right_label);
+
+  int lines = count_lines(scene.text);
+  int text_height = lines * font_height;
+  if (current_scene >= 0 && (left_label || right_label))
+    text_height += font_height;
+  result.overflow_y = text_height - HEIGHT;
+  result.overflow_x =
+      lines ? measure_text_width(scene.text) -
+                  scene_text_width(current_scene, scene)
+            : -WIDTH;
+  result.missing_glyphs = count_missing_glyphs(scene.text);
+
+  int labels_width = 0;
+  if (left_label) {
+    if (!text)
+      result.vram += text_vram(left_label);
+    result.missing_glyphs += count_missing_glyphs(left_label);
+    labels_width += measure_text_width(left_label);
+    free(left_label);
+  }
+  if (right_label) {
+    if (!text)
+      result.vram += text_vram(right_label);
+    result.missing_glyphs += count_missing_glyphs(right_label);
+    labels_width += measure_text_width(right_label);
+    free(right_label);
+  }
+  result.overflow_x = imax(result.overflow_x, labels_width - WIDTH);
+
+  if (transitions_count == transitions_capacity) {
+    transitions_capacity =
+        transitions_capacity ? 2 * transitions_capacity : 256;
+    transitions =
+        realloc(transitions, transitions_capacity * sizeof(transition));
+  }
+  transitions[transitions_count++] = result;
+
+  *(long *)data = heap_current;
+  heap_peak = heap_current;
+}
+
+////////////
+// Report //
+////////////
+
+int by_vram(const void *l, const void *r) {
+  long diff = ((const transition *)r)->vram - ((const transition *)l)->vram;
+  return diff > 0 ? 1 : diff < 0 ? -1 : 0;
+}
+
+int by_heap(const void *l, const void *r) {
+  long diff = ((const transition *)r)->heap - ((const transition *)l)->heap;
+  return diff > 0 ? 1 : diff < 0 ? -1 : 0;
+}
+
+void print_transition(const transition *t) {
+  if (t->from < 0)
+    printf("%21s -> %6d", "start", t->to);
+  else
+    printf("%6d via choice %d -> %6d", t->from, t->choice, t->to);
+}
+
+void print_worst(const char *title, int (*compare)(const void *, const void *),
+                 int count) {
+  transition *sorted = malloc(transitions_count * sizeof(transition));
+  memcpy(sorted, transitions, transitions_count * sizeof(transition));
+  qsort(sorted, transitions_count, sizeof(transition), compare);
+
+  printf("\n%s:\n", title);
+  printf("  %-31s %10s %10s %10s\n", "transition", "vram", "host us",
+         "heap");
+  for (int i = 0; i < count && i < transitions_count; i++) {
+    printf("  ");
+    print_transition(&sorted[i]);
+    printf(" %10ld %10ld %10ld\n", sorted[i].vram, sorted[i].host_ns / 1000,
+           sorted[i].heap);
+  }
+  free(sorted);
+}
+
+int main(int argc, char *argv[]) {
+  int count = 10;
+  long vram_budget = DEFAULT_VRAM_BUDGET;
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 < argc && strcmp(argv[i], "-n") == 0)
+      count = atoi(argv[i + 1]);
+    else if (i + 1 < argc && strcmp(argv[i], "-b") == 0)
+      vram_budget = atol(argv[i + 1]);
+    else {
+      fprintf(stderr, "Usage: %s [-n worst_count] [-b vram_budget]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  if (!map_hardware())
+    return 2;
+  // A new game, like the cartridge on first boot
+  progress_load();
+
+  long heap_base = heap_current;
+  heap_peak = heap_current;
+  int scenes = walk_scenes(measure, &heap_base);
+  if (scenes < 0)
+    return 1;
+
+  printf("Walked %d scene states through %d transitions\n", scenes,
+         transitions_count);
+
+  print_worst("Worst render cost", by_vram, count);
+  print_worst("Worst heap usage", by_heap, count);
+
+  int problems = 0;
+  for (int i = 0; i < transitions_count; i++) {
+    transition *t = &transitions[i];
+    if (t->overflow_x <= 0 && t->overflow_y <= 0 && t->leaked <= 0 &&
+        !t->missing_glyphs && t->vram <= vram_budget && !t->uncompiled &&
+        !t->miscompiled)
+      continue;
+
+    if (!problems)
+      printf("\nProblems:\n");
+    problems++;
+
+    printf("  ");
+    print_transition(t);
+    if (t->overflow_x > 0)
+      printf(", text is %dpx too wide", t->overflow_x);
+    if (t->overflow_y > 0)
+      printf(", text is %dpx too tall", t->overflow_y);
+    if (t->leaked > 0)
+      printf(", leaked %ld bytes", t->leaked);
+    if (t->missing_glyphs)
+      printf(", %d characters are missing from the font", t->missing_glyphs);
+    if (t->vram > vram_budget)
+      printf(", drawing takes %ld VRAM accesses, over the budget of %ld",
+             t->vram, vram_budget);
+    if (t->uncompiled)
+      printf(", text id %d is missing from compiled_scenes",
+             t->text_id);
+    if (t->miscompiled)
+      printf(", text id %d was compiled from a different scene",
+             t->text_id);
+    printf("\n");
+  }
+
+  if (!problems)
+    printf("\nNo problems found\n");
+
+  return problems ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "logic.h"
+#include "progress.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Scene indices are opaque to the walk, this only bounds runaway logic
+#define MAX_SCENES 65536
+#define SCENE_SET_SIZE (2 * MAX_SCENES)
+
+// Called once per transition, with from = -1 and choice = -1 for main_scene
+typedef void (*scene_visitor)(int from, int choice, int current_scene,
+                              scene scene, void *data);
+
+/* The same scene index can be reached with different progress, which the
+ * logic may look at. The walk goes through every scene and step_progress()
+ * pair, stepping from the first progress that reached it */
+typedef struct WalkState {
+  int scene;
+  uint32_t summary;
+  progress_state progress;
+} walk_state;
+
+walk_state scene_queue[MAX_SCENES];
+
+uint32_t walk_state_hash(const walk_state *state) {
+  uint32_t hash = (2166136261u ^ state->scene) * 16777619u;
+  return (hash ^ state->summary) * 16777619u;
+}
+
+bool walk_state_equal(const walk_state *l, const walk_state *r) {
+  return l->scene == r->scene && l->summary == r->summary;
+}
+
+// Open addressing over indices in scene_queue, allocated up front so the
+// walk itself never allocates between a step and its visit
+int scene_set_entries[SCENE_SET_SIZE];
+char scene_set_used[SCENE_SET_SIZE];
+
+// Returns 1 if scene_queue[entry] was added, 0 if it was already there
+int scene_set_add(int entry) {
+  int i = walk_state_hash(&scene_queue[entry]) & (SCENE_SET_SIZE - 1);
+  while (scene_set_used[i]) {
+    if (walk_state_equal(&scene_queue[scene_set_entries[i]],
+                         &scene_queue[entry]))
+      return 0;
+    i = (i + 1) & (SCENE_SET_SIZE - 1);
+  }
+  scene_set_used[i] = 1;
+  scene_set_entries[i] = entry;
+  return 1;
+}
+
+// Queues the scene with the current progress, returns false if it was
+// already reached with the same summary
+bool walk_queue(int *tail, int scene) {
+  scene_queue[*tail].scene = scene;
+  scene_queue[*tail].summary = step_progress();
+  progress_snapshot(&scene_queue[*tail].progress);
+  if (!scene_set_add(*tail))
+    return false;
+  (*tail)++;
+  return true;
+}
+
+/* Visits every transition reachable from main_scene with the current
+ * progress, breadth first, taking both choices from every scene the player
+ * can still act in, just like game.c does. Every step starts from the
+ * progress its scene was reached with. Start goes back to main_scene keeping
+ * the progress, so every new progress is walked from there too: main_scene
+ * looks the same whatever the progress, so that isn't visited again. Returns
+ * the number of distinct scene and summary pairs, or -1 if the logic produced
+ * more than MAX_SCENES */
+int walk_scenes(scene_visitor visit, void *data) {
+  int head = 0, tail = 0;
+
+  visit(-1, -1, 0, main_scene, data);
+  walk_queue(&tail, 0);
+
+  while (head < tail) {
+    const walk_state *from = &scene_queue[head++];
+    if (from->scene < 0)
+      continue;
+
+    for (int choice = 0; choice < 2; choice++) {
+      // Room for the next scene and the Start from it
+      if (tail + 2 > MAX_SCENES) {
+        fprintf(stderr, "More than %d scenes, giving up\n", MAX_SCENES);
+        return -1;
+      }
+
+      progress_restore(&from->progress);
+      int current_scene = from->scene;
+      scene next = step(&current_scene, choice);
+
+      // Queued before the visit, in case drawing records anything
+      bool added = walk_queue(&tail, current_scene);
+      visit(from->scene, choice, current_scene, next, data);
+
+      // Start on an ending is a new game, which is where the walk began
+      if (added && current_scene >= 0)
+        walk_queue(&tail, 0);
+    }
+  }
+
+  return tail;
+}